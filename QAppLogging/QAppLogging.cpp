@@ -1,5 +1,6 @@
 #include "QAppLogging.h"
 #include "filerotationstrategy.h"
+#include "sharedlogring.h"
 #include "windows.h"
 
 #include <QFile>
@@ -8,6 +9,15 @@
 #include <QMutex>
 #include <QCoreApplication>
 #include <QTextCodec>
+#include <QThread>
+#include <QWaitCondition>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #define LOG_FILE_SIZE           (256*1024*1024)
 #define LOG_INTKEY              "appCore"
@@ -18,13 +28,110 @@ QAPP_LOGGING_CATEGORY(AppCoreTrace,       LOG_INTKEY QAL_TAG_TRACE)
 QAtomicPointer<QAppLogging> QAppLogging::s_instance = 0;
 
 static QtMessageHandler g_oldMsgHandle;
+// serializes msgHandler, also held while the shared ring is replaced
+static QMutex g_msgHandlerMutex;
+
+#ifdef Q_OS_WIN
+static HANDLE nativeHandle(QFile *file)
+{
+    return reinterpret_cast<HANDLE>(_get_osfhandle(file->handle()));
+}
+#endif
+
+// push the data of the file down to the disk, metadata only when needed
+static bool syncFileData(QFile *file)
+{
+    const int fd = file->handle();
+    if (fd < 0) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return FlushFileBuffers(nativeHandle(file));
+#elif defined(Q_OS_LINUX)
+    return fdatasync(fd) == 0;
+#else
+    return fsync(fd) == 0;
+#endif
+}
+
+// reserve the blocks of a new segment without changing its size, so the
+// appends do not need to update the allocation metadata
+static void preallocateFile(QFile *file, qint64 size)
+{
+    const int fd = file->handle();
+    if (fd < 0 || size <= file->size()) {
+        return;
+    }
+#ifdef Q_OS_WIN
+    FILE_ALLOCATION_INFO info;
+    info.AllocationSize.QuadPart = size;
+    SetFileInformationByHandle(nativeHandle(file), FileAllocationInfo, &info, sizeof(info));
+#elif defined(Q_OS_LINUX)
+    fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size);
+#endif
+}
+
+// give back the blocks reserved by preallocateFile() behind the end of file
+static void trimFile(QFile *file, qint64 reserved)
+{
+    const int fd = file->handle();
+    const qint64 size = file->size();
+    if (fd < 0 || reserved <= size) {
+        return;
+    }
+#ifdef Q_OS_WIN
+    FILE_ALLOCATION_INFO info;
+    info.AllocationSize.QuadPart = size;
+    SetFileInformationByHandle(nativeHandle(file), FileAllocationInfo, &info, sizeof(info));
+#elif defined(Q_OS_LINUX)
+    // ftruncate to the same size does not free blocks past EOF everywhere
+    file->resize(size);
+    fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, size, reserved - size);
+#else
+    file->resize(size);
+#endif
+}
+
+class LogFileSyncThread : public QThread
+{
+public:
+    explicit LogFileSyncThread(int periodMs) : m_periodMs(periodMs), m_stop(false) {}
+
+    // wakes the thread up, does not wait for a whole period
+    void stop()
+    {
+        QMutexLocker lock(&m_mutex);
+        m_stop = true;
+        m_wake.wakeAll();
+    }
+
+protected:
+    void run() override
+    {
+        QMutexLocker lock(&m_mutex);
+        while (!m_stop) {
+            m_wake.wait(&m_mutex, m_periodMs);
+            if (m_stop) {
+                break;
+            }
+            lock.unlock();
+            QAppLogging::instance()->syncLogFile();
+            lock.relock();
+        }
+    }
+
+private:
+    int m_periodMs;
+    bool m_stop;
+    QMutex m_mutex;
+    QWaitCondition m_wake;
+};
 
 static void msgHandler(QtMsgType type,
                     const QMessageLogContext &context,
                     const QString &message)
 {
-    static QMutex mutex;
-    QMutexLocker lock(&mutex);
+    QMutexLocker lock(&g_msgHandlerMutex);
 
     QAppLogging *appLogging = QAppLogging::instance();
     QString logMessage;
@@ -34,6 +141,7 @@ static void msgHandler(QtMsgType type,
             break;
         }
 
+        appLogging->countRecords();
         logMessage = qFormatLogMessage(type, context, message);
         logMessage.append(QLatin1Char('\n'));
 
@@ -42,7 +150,7 @@ static void msgHandler(QtMsgType type,
         }
 
         if (destOption & QAppLogging::eDestFile) {
-            appLogging->writeLogFile(logMessage);
+            appLogging->writeLogFile(logMessage, type);
             /*
             QFile *logFile = appLogging->logFile();
             if (logFile) {
@@ -52,6 +160,10 @@ static void msgHandler(QtMsgType type,
             }
             */
         }
+
+        if (destOption & QAppLogging::eDestSharedRing) {
+            appLogging->writeSharedRing(logMessage, type);
+        }
     } while(0);
 
     switch (type) {
@@ -89,9 +201,19 @@ QAppLogging::QAppLogging()
     , m_logFileDir()
     , m_logFileName()
     , m_maxFileSize(LOG_FILE_SIZE)
+    , m_logFileFinished(false)
+    , m_durability(eDurabilityNone)
+    , m_preallocate(false)
+    , m_preallocatedSize(0)
+    , m_syncThread(nullptr)
+    , m_sharedRing(nullptr)
+    , m_recordCount(0)
+    , m_fileFailedCount(0)
+    , m_ringDroppedCount(0)
 {
     m_logFile = new QFile();
     m_logStream = new QTextStream();
+    m_logFileMutex = new QMutex();
 
     FileSizeRotationStrategy *strategy = new FileSizeRotationStrategy();
     strategy->setMaximumSizeInBytes(m_maxFileSize);
@@ -113,6 +235,10 @@ bool QAppLogging::createLogFile()
 
     QDateTime dtmCur = QDateTime::currentDateTime();
     QCoreApplication * app = QCoreApplication::instance();
+    if (!app) {
+        // the names are taken from the application
+        return false;
+    }
     QString logDir = m_logFileDir;
     QString logFileName = m_logFileName;
     if (logDir.isEmpty()) {
@@ -131,7 +257,12 @@ bool QAppLogging::createLogFile()
     currLogFilePath += logFileName;
 
     if (m_logFile->isOpen()==true) {
-        m_logFile->close();
+        closeLogFileSegment();
+    }
+    static bool closeAtExit = false;
+    if (!closeAtExit) {
+        qAddPostRoutine(closeLogFileAtExit);
+        closeAtExit = true;
     }
 
     m_logFile->setFileName(currLogFilePath);
@@ -139,16 +270,72 @@ bool QAppLogging::createLogFile()
         qDebug() << QObject::tr("open file %1 failed").arg(currLogFilePath);
         m_logStream->setDevice(nullptr);
     } else {
-        m_logStream->setDevice(m_logFile);
-        m_logStream->setCodec(QTextCodec::codecForName("UTF-8"));
-
-        m_fileRotationStrategy->setInitialInfo(*m_logFile);
+        openLogFileSegment();
         ret = true;
     }
 
     return ret;
 }
 
+void QAppLogging::openLogFileSegment()
+{
+    m_preallocatedSize = 0;
+    if (m_preallocate) {
+        preallocateFile(m_logFile, m_maxFileSize);
+        m_preallocatedSize = m_maxFileSize;
+    }
+
+    m_logStream->setDevice(m_logFile);
+    m_logStream->setCodec(QTextCodec::codecForName("UTF-8"));
+
+    m_fileRotationStrategy->setInitialInfo(*m_logFile);
+}
+
+void QAppLogging::closeLogFileSegment()
+{
+    m_logStream->setDevice(nullptr);
+    trimFile(m_logFile, m_preallocatedSize);
+    m_preallocatedSize = 0;
+    m_logFile->close();
+}
+
+/*!
+ * \brief QAppLogging::closeLogFileAtExit
+ *
+ * Post routine of the application: stop the periodic sync and close the last
+ * segment, so its preallocated blocks are given back. Records logged after
+ * that, e.g. from global destructors, are counted as failed instead of
+ * opening a new file without an application.
+ */
+void QAppLogging::closeLogFileAtExit()
+{
+    QAppLogging *appLogging = instance();
+    if (appLogging->m_syncThread) {
+        appLogging->m_syncThread->stop();
+        appLogging->m_syncThread->wait();
+    }
+
+    QMutexLocker lock(appLogging->m_logFileMutex);
+    if (appLogging->m_logFile->isOpen()) {
+        appLogging->closeLogFileSegment();
+    }
+    appLogging->m_logFileFinished = true;
+}
+
+/*!
+ * \brief QAppLogging::closeLogFile
+ *
+ * Close the current segment, the next record opens a new one.
+ */
+void QAppLogging::closeLogFile()
+{
+    QMutexLocker lock(m_logFileMutex);
+
+    if (m_logFile->isOpen()) {
+        closeLogFileSegment();
+    }
+}
+
 void QAppLogging::setLogFilePath(const QString &fileName, const QString &fileDir)
 {
     setLogFileDir(fileDir);
@@ -166,35 +353,191 @@ void QAppLogging::setLogFileBackupCount(const int count)
     static_cast<FileSizeRotationStrategy *>(m_fileRotationStrategy)->setBackupCount(count);
 }
 
+/*!
+ * \brief QAppLogging::setFileRotationStrategy
+ *
+ * Replace the size rotation strategy, e.g. with one overriding the file
+ * hooks for testing. QAppLogging takes the ownership of \a strategy.
+ */
+void QAppLogging::setFileRotationStrategy(FileSizeRotationStrategy *strategy)
+{
+    QMutexLocker lock(m_logFileMutex);
+
+    delete m_fileRotationStrategy;
+    strategy->setMaximumSizeInBytes(m_maxFileSize);
+    m_fileRotationStrategy = strategy;
+    if (m_logFile->isOpen()) {
+        m_fileRotationStrategy->setInitialInfo(*m_logFile);
+    }
+}
+
 void QAppLogging::setOutputDest(int value)
 {
     m_outputDest = value;
 }
 
-void QAppLogging::writeLogFile(const QString &message)
+/*!
+ * \brief QAppLogging::setLogFileDurability
+ *
+ * Choose how hard the file sink tries to get messages onto the disk.
+ * \a periodMs is only used by eDurabilityPeriodic.
+ */
+void QAppLogging::setLogFileDurability(Durability durability, int periodMs)
 {
+    // the thread takes the file lock to sync, stop it without holding it
+    if (m_syncThread) {
+        m_syncThread->stop();
+        m_syncThread->wait();
+        delete m_syncThread;
+        m_syncThread = nullptr;
+    }
+
+    m_logFileMutex->lock();
+    m_durability = durability;
+    m_logFileMutex->unlock();
+    if (durability == eDurabilityPeriodic) {
+        m_syncThread = new LogFileSyncThread(qMax(periodMs, 1));
+        m_syncThread->start(QThread::LowPriority);
+    }
+}
+
+/*!
+ * \brief QAppLogging::writeLogFile
+ *
+ * \a message may hold several \a records, they are all counted as failed
+ * when it cannot be written.
+ */
+bool QAppLogging::writeLogFile(const QString &message, QtMsgType type, int records)
+{
+    QMutexLocker lock(m_logFileMutex);
+
+    if (m_logFileFinished) {
+        m_fileFailedCount.fetchAndAddRelaxed(records);
+        return false;
+    }
     if (!m_logFile->isOpen()) {
         if (false == createLogFile()) {
-            return;
+            m_fileFailedCount.fetchAndAddRelaxed(records);
+            return false;
         }
     }
 
     const QByteArray utf8Message = message.toUtf8();
     m_fileRotationStrategy->includeMessageInCalculation(utf8Message);
     if (m_fileRotationStrategy->shouldRotate()) {
-        m_logStream->setDevice(nullptr);
-        m_logFile->close();
+        closeLogFileSegment();
         m_fileRotationStrategy->rotate();
         if (!m_logFile->open(QFile::WriteOnly | QFile::Text | m_fileRotationStrategy->recommendedOpenModeFlag())) {
             qDebug() << "QsLog: could not reopen log file " << qPrintable(m_logFile->fileName());
         }
-        m_fileRotationStrategy->setInitialInfo(*m_logFile);
-        m_logStream->setDevice(m_logFile);
-        m_logStream->setCodec(QTextCodec::codecForName("UTF-8"));
+        openLogFileSegment();
     }
 
     *m_logStream << utf8Message; //<< endl;
     m_logStream->flush();
+    if (m_logStream->status() != QTextStream::Ok) {
+        m_logStream->resetStatus();
+        m_fileFailedCount.fetchAndAddRelaxed(records);
+        return false;
+    }
+
+    if (m_durability == eDurabilityBatch
+            || (m_durability == eDurabilityCritical
+                && (type == QtCriticalMsg || type == QtFatalMsg))) {
+        syncFileData(m_logFile);
+    }
+    return true;
+}
+
+/*!
+ * \brief QAppLogging::syncLogFile
+ *
+ * Used by eDurabilityPeriodic, only the duplication of the file handle is
+ * done under the file lock, logging threads do not wait for the disk.
+ */
+void QAppLogging::syncLogFile()
+{
+    QMutexLocker lock(m_logFileMutex);
+    if (!m_logFile->isOpen() || m_logFile->handle() < 0) {
+        return;
+    }
+    m_logStream->flush();
+
+    // the duplicate stays valid if the segment is rotated meanwhile
+#ifdef Q_OS_WIN
+    HANDLE handle = INVALID_HANDLE_VALUE;
+    if (!DuplicateHandle(GetCurrentProcess(), nativeHandle(m_logFile), GetCurrentProcess(),
+                         &handle, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+        return;
+    }
+    lock.unlock();
+    FlushFileBuffers(handle);
+    CloseHandle(handle);
+#else
+    const int fd = dup(m_logFile->handle());
+    if (fd < 0) {
+        return;
+    }
+    lock.unlock();
+#if defined(Q_OS_LINUX)
+    fdatasync(fd);
+#else
+    fsync(fd);
+#endif
+    ::close(fd);
+#endif
+}
+
+/*!
+ * \brief QAppLogging::setSharedRing
+ *
+ * Attach to the shared memory ring named \a key, create it with \a capacity
+ * bytes if no other process did it yet. Messages are appended to the ring
+ * when eDestSharedRing is set in the output destination, the logCollector
+ * process merges them into one rotated file set.
+ *
+ * The ring is swapped under the message handler lock, so it may be changed
+ * while other threads log. Direct writeSharedRing() calls are not covered
+ * and must not race with this.
+ *
+ * \return false if the segment could not be created or attached
+ */
+bool QAppLogging::setSharedRing(const QString &key, quint32 capacity)
+{
+    SharedLogRing *ring = new SharedLogRing(key);
+    const bool opened = ring->open(capacity ? capacity : SharedLogRing::DefaultCapacity);
+    const QString error = ring->errorString();
+    if (!opened) {
+        delete ring;
+        ring = nullptr;
+    }
+
+    g_msgHandlerMutex.lock();
+    SharedLogRing *oldRing = m_sharedRing;
+    m_sharedRing = ring;
+    g_msgHandlerMutex.unlock();
+    delete oldRing;
+
+    // logging only once the handler lock is released
+    if (!opened) {
+        qDebug() << QObject::tr("open shared ring %1 failed: %2").arg(key).arg(error);
+        return false;
+    }
+
+    return true;
+}
+
+bool QAppLogging::writeSharedRing(const QString &message, QtMsgType type)
+{
+    if (!m_sharedRing) {
+        return false;
+    }
+
+    if (!m_sharedRing->append(message.toUtf8(), type)) {
+        m_ringDroppedCount.fetchAndAddRelaxed(1);
+        return false;
+    }
+    return true;
 }
 
 void QAppLogging::registerCategory(const char *category, QtMsgType severityLevel)
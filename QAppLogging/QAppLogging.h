@@ -3,6 +3,7 @@
 
 #include <QLoggingCategory>
 #include <QStringList>
+#include <QAtomicInteger>
 
 // Add global logging categories (not class specific)
 Q_DECLARE_LOGGING_CATEGORY(AppCore)
@@ -39,7 +40,11 @@ struct QAppCategoryOptions {
 };
 
 class QFile;
+class QMutex;
+class LogFileSyncThread;
 class FileRotationStrategy;
+class FileSizeRotationStrategy;
+class SharedLogRing;
 
 class QAppLogging : public QObject
 {
@@ -49,7 +54,8 @@ public :
     enum LogDest {
         eDestNone       = 0x00,
         eDestSystem     = 0x01,
-        eDestFile       = 0x02
+        eDestFile       = 0x02,
+        eDestSharedRing = 0x04
     };
 
     enum LogLevel
@@ -63,6 +69,14 @@ public :
         OffLevel
     };
 
+    enum Durability
+    {
+        eDurabilityNone = 0,    // flush to the OS only, may lose the tail on power loss
+        eDurabilityPeriodic,    // fdatasync from a background thread every period
+        eDurabilityBatch,       // fdatasync after every write
+        eDurabilityCritical     // fdatasync after critical/fatal messages only
+    };
+
     static QAppLogging *instance()
     {
         QAppLogging *inst = s_instance.loadAcquire();
@@ -85,7 +99,23 @@ public :
     void setLogFilePath(const QString &fileName, const QString &fileDir = ".");
     void setLogFileMaxSize(const quint64 fileSize);
     void setLogFileBackupCount(const int count);
-    void writeLogFile(const QString &message);
+    void setFileRotationStrategy(FileSizeRotationStrategy *strategy);
+    void setLogFileDurability(Durability durability, int periodMs = 1000);
+    Durability logFileDurability() const {return m_durability;}
+    // off by default, reserves the maximum file size for each new segment
+    void setLogFilePreallocation(bool enable) {m_preallocate = enable;}
+    bool writeLogFile(const QString &message, QtMsgType type = QtDebugMsg, int records = 1);
+    void syncLogFile();
+    void closeLogFile();
+    bool setSharedRing(const QString &key, quint32 capacity = 0);
+    bool writeSharedRing(const QString &message, QtMsgType type = QtDebugMsg);
+    // records logged once each whatever the destinations, the message handler
+    // counts its own, writers calling writeLogFile() directly count theirs
+    void countRecords(int records = 1) {m_recordCount.fetchAndAddRelaxed(records);}
+    quint64 recordCount() const {return m_recordCount.load();}
+    // records lost by each sink
+    quint64 fileFailedCount() const {return m_fileFailedCount.load();}
+    quint64 ringDroppedCount() const {return m_ringDroppedCount.load();}
 
     void registerCategory(const char *category, QtMsgType severityLevel = QtDebugMsg);
     QStringList registeredCategories(void);
@@ -95,7 +125,10 @@ public :
 
 private:
     QAppLogging();
+    static void closeLogFileAtExit();
     bool createLogFile();
+    void openLogFileSegment();
+    void closeLogFileSegment();
 
     static QAtomicPointer<QAppLogging> s_instance;
     int m_outputDest;
@@ -104,7 +137,17 @@ private:
     quint64 m_maxFileSize;
     QFile *m_logFile;
     QTextStream *m_logStream;
+    QMutex *m_logFileMutex;
+    bool m_logFileFinished;         // closed at exit, never reopened
+    Durability m_durability;
+    bool m_preallocate;
+    qint64 m_preallocatedSize;
+    LogFileSyncThread *m_syncThread;
     FileRotationStrategy *m_fileRotationStrategy;
+    SharedLogRing *m_sharedRing;
+    QAtomicInteger<quint64> m_recordCount;
+    QAtomicInteger<quint64> m_fileFailedCount;
+    QAtomicInteger<quint64> m_ringDroppedCount;
 
     QList<QAppCategoryOptions> _registeredCategories;
 };
@@ -3,11 +3,13 @@ INCLUDEPATH += $$PWD
 
 SOURCES += \
     $$PWD/QAppLogging.cpp \
-    $$PWD/filerotationstrategy.cpp
+    $$PWD/filerotationstrategy.cpp \
+    $$PWD/sharedlogring.cpp
 
 HEADERS += \
     $$PWD/QAppLogging.h \
-    $$PWD/filerotationstrategy.h
+    $$PWD/filerotationstrategy.h \
+    $$PWD/sharedlogring.h
 
 
 OTHER_FILES += \
@@ -0,0 +1,19 @@
+#-------------------------------------------------
+#
+# Collector merging the QAppLogging shared rings
+# of all processes into one rotated file set
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = logCollector
+TEMPLATE = app
+
+include(../QAppLogging.pri)
+
+SOURCES += main.cpp
@@ -0,0 +1,110 @@
+#include "QAppLogging.h"
+#include "sharedlogring.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTimer>
+#include <QDebug>
+
+#define COLLECT_INTERVAL_MS     50
+#define COLLECT_BATCH_SIZE      4096
+
+/*
+ * Drain the shared ring into the rotated file set. All records taken in one
+ * pass are written with a single writeLogFile() call, so there is one flush
+ * per batch instead of one per message and per process. A batch holding a
+ * critical or fatal record is written as critical for eDurabilityCritical.
+ */
+static void collect(SharedLogRing *ring)
+{
+    QList<SharedLogRing::Record> records;
+    while (ring->takeAll(records, COLLECT_BATCH_SIZE) > 0) {
+        QByteArray batch;
+        QtMsgType type = QtDebugMsg;
+        foreach (const SharedLogRing::Record &record, records) {
+            batch += '[' + QByteArray::number(record.pid) + "] ";
+            batch += record.message;
+            if (record.type == QtCriticalMsg || record.type == QtFatalMsg) {
+                type = QtCriticalMsg;
+            }
+        }
+        QAppLogging *appLogging = QAppLogging::instance();
+        appLogging->countRecords(records.size());
+        appLogging->writeLogFile(QString::fromUtf8(batch), type, records.size());
+        records.clear();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Merge QAppLogging shared ring records into one log file set");
+    parser.addHelpOption();
+    QCommandLineOption keyOption("key", "Shared memory key of the ring.", "key", "QAppLogging");
+    QCommandLineOption sizeOption("ring-size", "Ring capacity in bytes when the collector creates it.", "bytes");
+    QCommandLineOption dirOption("dir", "Directory of the log files.", "dir");
+    QCommandLineOption nameOption("name", "Log file name.", "name", "collector.txt");
+    QCommandLineOption maxSizeOption("max-size", "Maximum size of one log file in bytes.", "bytes");
+    QCommandLineOption backupOption("backups", "Number of rotated backups to keep.", "count");
+    QCommandLineOption durabilityOption("durability", "File durability: none, periodic, batch or critical.", "tier", "none");
+    QCommandLineOption stallOption("stall-timeout", "Milliseconds before a reservation that was never marked is skipped, 0 never skips.", "ms");
+    parser.addOption(keyOption);
+    parser.addOption(sizeOption);
+    parser.addOption(dirOption);
+    parser.addOption(nameOption);
+    parser.addOption(maxSizeOption);
+    parser.addOption(backupOption);
+    parser.addOption(durabilityOption);
+    parser.addOption(stallOption);
+    parser.process(app);
+
+    QAppLogging *appLogging = QAppLogging::instance();
+    appLogging->setOutputDest(QAppLogging::eDestFile);
+    appLogging->setLogFileName(parser.value(nameOption));
+    if (parser.isSet(dirOption)) {
+        appLogging->setLogFileDir(parser.value(dirOption));
+    }
+    if (parser.isSet(maxSizeOption)) {
+        appLogging->setLogFileMaxSize(parser.value(maxSizeOption).toULongLong());
+    }
+    if (parser.isSet(backupOption)) {
+        appLogging->setLogFileBackupCount(parser.value(backupOption).toInt());
+    }
+    const QString durability = parser.value(durabilityOption);
+    if (durability == "periodic") {
+        appLogging->setLogFileDurability(QAppLogging::eDurabilityPeriodic);
+    } else if (durability == "batch") {
+        appLogging->setLogFileDurability(QAppLogging::eDurabilityBatch);
+    } else if (durability == "critical") {
+        appLogging->setLogFileDurability(QAppLogging::eDurabilityCritical);
+    } else if (durability != "none") {
+        qCritical() << "unknown durability" << durability;
+        return 1;
+    }
+
+    SharedLogRing ring(parser.value(keyOption));
+    quint32 capacity = SharedLogRing::DefaultCapacity;
+    if (parser.isSet(sizeOption)) {
+        capacity = parser.value(sizeOption).toUInt();
+    }
+    if (!ring.open(capacity)) {
+        qCritical() << "open shared ring" << parser.value(keyOption) << "failed:" << ring.errorString();
+        return 1;
+    }
+    if (parser.isSet(stallOption)) {
+        ring.setStallTimeout(parser.value(stallOption).toInt());
+    }
+
+    QTimer timer;
+    QObject::connect(&timer, &QTimer::timeout, [&ring]() {
+        collect(&ring);
+    });
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, [&ring]() {
+        collect(&ring);
+    });
+    timer.start(COLLECT_INTERVAL_MS);
+
+    return app.exec();
+}
@@ -0,0 +1,314 @@
+#include "sharedlogring.h"
+
+#include <QAtomicInteger>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QThread>
+
+#include <new>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <errno.h>
+#include <signal.h>
+#endif
+
+#define RING_MAGIC              0x51414c32  // "QAL2"
+#define RING_ALIGN              8
+#define RING_PADDING_FLAG       0x80000000u
+#define RING_RESERVED_FLAG      0x40000000u
+#define RING_SIZE_MASK          0x3fffffffu
+#define RING_ATTACH_RETRY       100
+
+const quint32 SharedLogRing::DefaultCapacity = 4*1024*1024;
+const int SharedLogRing::DefaultStallTimeoutMs = 5000;
+
+/*
+ * Segment layout:
+ *
+ * | Header | data[capacity] |
+ *
+ * head and tail are monotonic byte counters, the position in data is the
+ * counter modulo capacity. A record never wraps around the end of data, when
+ * it does not fit a padding record is reserved together with it.
+ *
+ * Every record starts with a 32-bit commit word. Right after the reservation
+ * the producer stores its pid and marks the word RESERVED with the size, once
+ * the record is filled the word holds the size alone. The collector zeroes
+ * the bytes it consumed before giving them back through tail, so a word that
+ * is still 0 belongs to a producer between its reservation and its mark.
+ */
+struct SharedLogRing::Header {
+    QBasicAtomicInteger<quint32> magic;
+    quint32 capacity;
+    QBasicAtomicInteger<quint64> head;
+    QBasicAtomicInteger<quint64> tail;
+    QBasicAtomicInteger<quint64> dropped;
+};
+
+struct RecordHeader {
+    QBasicAtomicInteger<quint32> commit;
+    quint32 messageSize;
+    qint64 pid;
+    qint64 timestamp;
+    qint32 type;
+    quint32 reserved;
+};
+
+static inline quint32 alignedSize(quint32 size)
+{
+    return (size + RING_ALIGN - 1) & ~quint32(RING_ALIGN - 1);
+}
+
+static bool processAlive(qint64 pid)
+{
+#ifdef Q_OS_WIN
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, DWORD(pid));
+    if (!process) {
+        return GetLastError() == ERROR_ACCESS_DENIED;
+    }
+    DWORD exitCode = 0;
+    const BOOL ok = GetExitCodeProcess(process, &exitCode);
+    CloseHandle(process);
+    return !ok || exitCode == STILL_ACTIVE;
+#else
+    return kill(pid_t(pid), 0) == 0 || errno == EPERM;
+#endif
+}
+
+SharedLogRing::SharedLogRing(const QString &key)
+    : m_sharedMemory(key)
+    , m_stallTimeoutMs(DefaultStallTimeoutMs)
+    , m_stallTail(0)
+    , m_stallHead(0)
+{
+}
+
+SharedLogRing::~SharedLogRing()
+{
+    if (m_sharedMemory.isAttached()) {
+        m_sharedMemory.detach();
+    }
+}
+
+bool SharedLogRing::open(quint32 capacity)
+{
+    if (isOpen()) {
+        return true;
+    }
+
+    capacity = alignedSize(qMax<quint32>(capacity, 64*1024));
+    if (m_sharedMemory.create(int(sizeof(Header) + capacity))) {
+        m_sharedMemory.lock();
+        Header *h = new (m_sharedMemory.data()) Header;
+        h->capacity = capacity;
+        h->head.store(0);
+        h->tail.store(0);
+        h->dropped.store(0);
+        memset(data(), 0, capacity);
+        h->magic.storeRelease(RING_MAGIC);
+        m_sharedMemory.unlock();
+        return true;
+    }
+
+    if (m_sharedMemory.error() != QSharedMemory::AlreadyExists
+            || !m_sharedMemory.attach()) {
+        return false;
+    }
+
+    // the creator may still be initializing the header
+    for (int i = 0; i < RING_ATTACH_RETRY; ++i) {
+        if (header()->magic.loadAcquire() == RING_MAGIC) {
+            return true;
+        }
+        QThread::msleep(1);
+    }
+
+    m_sharedMemory.detach();
+    return false;
+}
+
+bool SharedLogRing::isOpen() const
+{
+    return m_sharedMemory.isAttached()
+            && header()->magic.loadAcquire() == RING_MAGIC;
+}
+
+QString SharedLogRing::errorString() const
+{
+    return m_sharedMemory.errorString();
+}
+
+bool SharedLogRing::append(const QByteArray &message, QtMsgType type)
+{
+    Header *h = header();
+    const quint32 capacity = h->capacity;
+    const quint32 size = alignedSize(sizeof(RecordHeader) + message.size());
+    if (size > capacity || size > RING_SIZE_MASK) {
+        h->dropped.fetchAndAddRelaxed(1);
+        return false;
+    }
+
+    // 1. reserve
+    quint64 head;
+    quint32 offset;
+    quint32 padding;
+    do {
+        head = h->head.loadAcquire();
+        const quint64 tail = h->tail.loadAcquire();
+        offset = quint32(head % capacity);
+        padding = (offset + size > capacity) ? capacity - offset : 0;
+        if (head + padding + size - tail > capacity) {
+            h->dropped.fetchAndAddRelaxed(1);
+            return false;
+        }
+    } while (!h->head.testAndSetOrdered(head, head + padding + size));
+
+    // 2. fill the tail of data with padding, the record starts at 0
+    if (padding) {
+        QBasicAtomicInteger<quint32> *commit =
+                reinterpret_cast<QBasicAtomicInteger<quint32> *>(data() + offset);
+        commit->storeRelease(padding | RING_PADDING_FLAG);
+        offset = 0;
+    }
+
+    // 3. mark the reservation so the collector can tell whose it is
+    RecordHeader *record = reinterpret_cast<RecordHeader *>(data() + offset);
+    record->pid = QCoreApplication::applicationPid();
+    record->commit.storeRelease(size | RING_RESERVED_FLAG);
+
+    // 4. fill and commit the record
+    record->messageSize = quint32(message.size());
+    record->timestamp = QDateTime::currentMSecsSinceEpoch();
+    record->type = qint32(type);
+    memcpy(data() + offset + sizeof(RecordHeader), message.constData(), message.size());
+    record->commit.storeRelease(size);
+
+    return true;
+}
+
+int SharedLogRing::takeAll(QList<Record> &records, int maxRecords)
+{
+    Header *h = header();
+    const quint32 capacity = h->capacity;
+    const quint64 head = h->head.loadAcquire();
+    quint64 tail = h->tail.load();
+    int count = 0;
+
+    while (tail < head && (maxRecords < 0 || count < maxRecords)) {
+        const quint32 offset = quint32(tail % capacity);
+        QBasicAtomicInteger<quint32> *commit =
+                reinterpret_cast<QBasicAtomicInteger<quint32> *>(data() + offset);
+        const quint32 word = commit->loadAcquire();
+        if (word == 0) {
+            // reserved but not marked yet, keep the reservation order unless
+            // it has been like this for too long
+            const quint64 skipped = skipStalled(tail, head);
+            if (skipped == tail) {
+                break;
+            }
+            tail = skipped;
+            continue;
+        }
+
+        const quint32 size = word & RING_SIZE_MASK;
+        if (word & RING_RESERVED_FLAG) {
+            const RecordHeader *record = reinterpret_cast<const RecordHeader *>(data() + offset);
+            if (processAlive(record->pid)) {
+                // still being filled
+                break;
+            }
+            // the producer died before committing
+            h->dropped.fetchAndAddRelaxed(1);
+        } else if (!(word & RING_PADDING_FLAG)) {
+            const RecordHeader *record = reinterpret_cast<const RecordHeader *>(data() + offset);
+            Record r;
+            r.pid = record->pid;
+            r.timestamp = record->timestamp;
+            r.type = QtMsgType(record->type);
+            r.message = QByteArray(data() + offset + sizeof(RecordHeader), int(record->messageSize));
+            records.append(r);
+            ++count;
+        }
+
+        memset(data() + offset, 0, size);
+        tail += size;
+    }
+
+    h->tail.storeRelease(tail);
+    return count;
+}
+
+/*
+ * Called when the record at tail has no mark. After the stall timeout at the
+ * same tail its producer is taken as dead. Apart from its pid the unmarked
+ * bytes are all zero, so the next record starts at the next non-zero commit
+ * word behind the pid.
+ *
+ * The skip never goes past the head seen when the stall began, an unmarked
+ * reservation made after that has not been waited for and is kept.
+ *
+ * Returns the new tail, or tail itself to keep waiting.
+ */
+quint64 SharedLogRing::skipStalled(quint64 tail, quint64 head)
+{
+    if (m_stallTimeoutMs <= 0) {
+        return tail;
+    }
+    if (tail != m_stallTail || !m_stallClock.isValid()) {
+        m_stallTail = tail;
+        m_stallHead = head;
+        m_stallClock.start();
+        return tail;
+    }
+    if (m_stallClock.elapsed() < m_stallTimeoutMs) {
+        return tail;
+    }
+    head = qMin(head, m_stallHead);
+
+    // only the pid of an unmarked record may have been written
+    Header *h = header();
+    const quint32 capacity = h->capacity;
+    quint64 next = tail + offsetof(RecordHeader, timestamp);
+    while (next < head) {
+        const QBasicAtomicInteger<quint32> *commit =
+                reinterpret_cast<const QBasicAtomicInteger<quint32> *>(data() + next % capacity);
+        const quint32 word = commit->loadAcquire();
+        if (word != 0) {
+            // a marked record has its pid behind the commit word, the
+            // timestamp behind the pid of an unmarked one is still 0
+            if (!(word & RING_PADDING_FLAG) && next + RING_ALIGN < head
+                    && *reinterpret_cast<const qint64 *>(data() + (next + RING_ALIGN) % capacity) == 0) {
+                next -= offsetof(RecordHeader, pid);
+            }
+            break;
+        }
+        next += RING_ALIGN;
+    }
+    next = qMin(next, head);
+    for (quint64 t = tail; t < next; t += RING_ALIGN) {
+        memset(data() + t % capacity, 0, RING_ALIGN);
+    }
+
+    h->dropped.fetchAndAddRelaxed(1);
+    m_stallClock.invalidate();
+    return next;
+}
+
+quint64 SharedLogRing::droppedCount() const
+{
+    return isOpen() ? header()->dropped.load() : 0;
+}
+
+SharedLogRing::Header *SharedLogRing::header() const
+{
+    return static_cast<Header *>(const_cast<void *>(m_sharedMemory.constData()));
+}
+
+char *SharedLogRing::data() const
+{
+    return reinterpret_cast<char *>(header()) + sizeof(Header);
+}
@@ -0,0 +1,83 @@
+#ifndef SHAREDLOGRING_H
+#define SHAREDLOGRING_H
+
+#include <QSharedMemory>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+/*!
+ * \brief SharedLogRing is a ring buffer of log records living in a named
+ * shared memory segment.
+ *
+ * Several producer processes append records, the space of a record is
+ * reserved with a compare-and-swap on the shared head counter, so producers
+ * never block each other. A single collector process drains the committed
+ * records in reservation order and releases the space by moving the tail.
+ *
+ * When the ring is full the record is dropped and the drop counter in the
+ * segment header is increased, a producer never waits for the collector.
+ *
+ * A producer dying between reservation and commit would block the tail for
+ * good, the collector skips reservations of dead processes and, after the
+ * stall timeout, reservations that were never marked.
+ *
+ * The mark is written right after the reservation, not with it. A producer
+ * stopped in between for longer than the stall timeout (SIGSTOP, debugger,
+ * starved under load) is taken as dead, and when it resumes it writes into
+ * space the collector has already given back, which corrupts the ring for
+ * every process. Raise the timeout where producers can be stopped that long,
+ * or disable the skipping with a timeout of 0.
+ */
+class SharedLogRing
+{
+    Q_DISABLE_COPY(SharedLogRing)
+
+public:
+    static const quint32 DefaultCapacity;
+    static const int DefaultStallTimeoutMs;
+
+    struct Record {
+        qint64 pid;
+        qint64 timestamp;
+        QtMsgType type;
+        QByteArray message;
+    };
+
+    explicit SharedLogRing(const QString &key);
+    ~SharedLogRing();
+
+    // create the segment if it does not exist yet, otherwise attach to it
+    bool open(quint32 capacity = DefaultCapacity);
+    bool isOpen() const;
+    QString errorString() const;
+
+    // producer side, safe to call from many processes at the same time
+    bool append(const QByteArray &message, QtMsgType type = QtDebugMsg);
+
+    // collector side, only one process may drain the ring
+    int takeAll(QList<Record> &records, int maxRecords = -1);
+
+    quint64 droppedCount() const;
+
+    // collector side, 0 never skips unmarked reservations
+    void setStallTimeout(int ms) {m_stallTimeoutMs = ms;}
+    int stallTimeout() const {return m_stallTimeoutMs;}
+
+private:
+    struct Header;
+
+    Header *header() const;
+    char *data() const;
+    quint64 skipStalled(quint64 tail, quint64 head);
+
+    QSharedMemory m_sharedMemory;
+    int m_stallTimeoutMs;
+    quint64 m_stallTail;
+    quint64 m_stallHead;
+    QElapsedTimer m_stallClock;
+};
+
+#endif // SHAREDLOGRING_H
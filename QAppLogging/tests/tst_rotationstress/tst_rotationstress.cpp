@@ -0,0 +1,389 @@
+#include "QAppLogging.h"
+#include "filerotationstrategy.h"
+
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QHash>
+#include <QVector>
+
+#define HISTOGRAM_BUCKETS       32
+#define DEFAULT_MESSAGE_PATTERN "%{if-category}%{category}: %{endif}%{message}"
+
+/*
+ * FileSizeRotationStrategy timing every rotation, the file hooks are the
+ * real ones.
+ *
+ * A rotation is timed from shouldRotate() to the setInitialInfo() of the
+ * reopened segment, so closing, renaming and reopening are all included.
+ * Time spent in m_injectedNs by a subclass is taken out of the measure.
+ *
+ * All hooks run under the file sink mutex of QAppLogging, no locking here.
+ */
+class TimedFileSizeRotationStrategy : public FileSizeRotationStrategy
+{
+public:
+    TimedFileSizeRotationStrategy()
+        : m_injectedNs(0)
+        , m_rotations(0)
+        , m_histogram(HISTOGRAM_BUCKETS, 0)
+    {
+    }
+
+    bool shouldRotate() override
+    {
+        const bool rotate = FileSizeRotationStrategy::shouldRotate();
+        if (rotate) {
+            m_injectedNs = 0;
+            m_rotationTimer.start();
+        }
+        return rotate;
+    }
+
+    void setInitialInfo(const QFile &file) override
+    {
+        FileSizeRotationStrategy::setInitialInfo(file);
+
+        if (m_rotationTimer.isValid()) {
+            const qint64 us = (m_rotationTimer.nsecsElapsed() - m_injectedNs) / 1000;
+            m_rotationTimer.invalidate();
+
+            int bucket = 0;
+            while ((qint64(1) << bucket) <= us && bucket < HISTOGRAM_BUCKETS - 1) {
+                ++bucket;
+            }
+            ++m_histogram[bucket];
+            ++m_rotations;
+        }
+    }
+
+    int rotations() const {return m_rotations;}
+    const QVector<int> &histogram() const {return m_histogram;}
+
+protected:
+    qint64 m_injectedNs;
+
+private:
+    int m_rotations;
+    QElapsedTimer m_rotationTimer;
+    QVector<int> m_histogram;
+};
+
+/*
+ * TimedFileSizeRotationStrategy with the file hooks backed by memory.
+ *
+ * The active segment is the real file written by QAppLogging. When it is
+ * renamed to a backup its content moves into memory and is also appended to
+ * the list of completed segments, so the full message stream can be rebuilt
+ * even after backups are dropped. Failures and latency are injected into
+ * every hook.
+ */
+class FaultyFileSizeRotationStrategy : public TimedFileSizeRotationStrategy
+{
+public:
+    FaultyFileSizeRotationStrategy(int failurePercent, int latencyUs, quint32 seed)
+        : m_failurePercent(failurePercent)
+        , m_latencyUs(latencyUs)
+        , m_random(seed ? seed : 1)
+        , m_failures(0)
+    {
+    }
+
+    void setInitialInfo(const QFile &file) override
+    {
+        m_activeFileName = file.fileName();
+        TimedFileSizeRotationStrategy::setInitialInfo(file);
+    }
+
+    QByteArray stream() const
+    {
+        QByteArray all;
+        foreach (const QByteArray &segment, m_segments) {
+            all += segment;
+        }
+        QFile file(m_activeFileName);
+        if (file.open(QIODevice::ReadOnly)) {
+            all += file.readAll();
+        }
+        return all;
+    }
+
+    int failures() const {return m_failures;}
+    int segments() const {return m_segments.size();}
+
+protected:
+    bool removeFileAtPath(const QString &path) override
+    {
+        if (injectFault()) {
+            return false;
+        }
+        if (path == m_activeFileName) {
+            return QFile::remove(path);
+        }
+        return m_files.remove(path) > 0;
+    }
+
+    bool fileExistsAtPath(const QString &path) override
+    {
+        if (path == m_activeFileName) {
+            return QFile::exists(path);
+        }
+        return m_files.contains(path);
+    }
+
+    bool renameFileFromTo(const QString &from, const QString &to) override
+    {
+        if (injectFault()) {
+            return false;
+        }
+        if (from != m_activeFileName) {
+            if (!m_files.contains(from)) {
+                return false;
+            }
+            m_files.insert(to, m_files.take(from));
+            return true;
+        }
+
+        QFile file(from);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        const QByteArray content = file.readAll();
+        file.close();
+        if (!QFile::remove(from)) {
+            return false;
+        }
+        m_files.insert(to, content);
+        m_segments.append(content);
+        return true;
+    }
+
+private:
+    bool injectFault()
+    {
+        if (m_latencyUs > 0) {
+            QElapsedTimer sleep;
+            sleep.start();
+            QThread::usleep(nextRandom() % (m_latencyUs + 1));
+            m_injectedNs += sleep.nsecsElapsed();
+        }
+        if (m_failurePercent > 0 && int(nextRandom() % 100) < m_failurePercent) {
+            ++m_failures;
+            return true;
+        }
+        return false;
+    }
+
+    quint32 nextRandom()
+    {
+        // xorshift32, deterministic for a given seed
+        m_random ^= m_random << 13;
+        m_random ^= m_random >> 17;
+        m_random ^= m_random << 5;
+        return m_random;
+    }
+
+    int m_failurePercent;
+    int m_latencyUs;
+    quint32 m_random;
+    int m_failures;
+    QString m_activeFileName;
+    QHash<QString, QByteArray> m_files;
+    QList<QByteArray> m_segments;
+};
+
+class ProducerThread : public QThread
+{
+public:
+    ProducerThread(int id, int count) : m_id(id), m_count(count) {}
+
+protected:
+    void run() override
+    {
+        for (int i = 0; i < m_count; ++i) {
+            qDebug("T%d %d", m_id, i);
+        }
+    }
+
+private:
+    int m_id;
+    int m_count;
+};
+
+class TestRotationStress : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void stress_data();
+    void stress();
+    void rotationLatency();
+
+private:
+    void runProducers(TimedFileSizeRotationStrategy *strategy, const QString &dir,
+                      int maxSize, int threads, int count);
+    QStringList verifyStream(const QByteArray &stream, int threads, int count);
+    qint64 histogramPercentile(const QVector<int> &histogram, int total, int percent);
+};
+
+/*
+ * Log from all threads through QAppLogging into a fresh file set, the
+ * QTest message handler is put back before returning.
+ */
+void TestRotationStress::runProducers(TimedFileSizeRotationStrategy *strategy, const QString &dir,
+                                      int maxSize, int threads, int count)
+{
+    QAppLogging *appLogging = QAppLogging::instance();
+    appLogging->closeLogFile();
+    appLogging->setLogFilePath("stress.txt", dir);
+    appLogging->setFileRotationStrategy(strategy);
+    appLogging->setLogFileMaxSize(maxSize);
+    // without backups rotation deletes records by design
+    appLogging->setLogFileBackupCount(3);
+    appLogging->setOutputDest(QAppLogging::eDestFile);
+
+    QtMessageHandler testHandler = qInstallMessageHandler(0);
+    QAppLogging::installHandler();
+    qSetMessagePattern("%{message}");
+
+    QList<ProducerThread *> producers;
+    for (int id = 0; id < threads; ++id) {
+        producers.append(new ProducerThread(id, count));
+    }
+    foreach (ProducerThread *producer, producers) {
+        producer->start();
+    }
+    foreach (ProducerThread *producer, producers) {
+        producer->wait();
+        delete producer;
+    }
+
+    appLogging->setOutputDest(QAppLogging::eDestNone);
+    appLogging->closeLogFile();
+    qInstallMessageHandler(testHandler);
+    qSetMessagePattern(DEFAULT_MESSAGE_PATTERN);
+}
+
+/*
+ * Every thread must show up with 0..count-1 exactly once and in order.
+ */
+QStringList TestRotationStress::verifyStream(const QByteArray &stream, int threads, int count)
+{
+    QVector<int> next(threads, 0);
+    QStringList errors;
+
+    foreach (const QByteArray &line, stream.split('\n')) {
+        if (line.isEmpty()) {
+            continue;
+        }
+        const QList<QByteArray> fields = line.mid(1).split(' ');
+        bool okId = false;
+        bool okSeq = false;
+        const int id = fields.value(0).toInt(&okId);
+        const int seq = fields.value(1).toInt(&okSeq);
+        if (line.at(0) != 'T' || !okId || !okSeq || id < 0 || id >= threads) {
+            errors << QString("corrupted record: %1").arg(QString::fromUtf8(line));
+            continue;
+        }
+        if (seq != next[id]) {
+            errors << QString("thread %1: expected %2, got %3 (%4)")
+                      .arg(id).arg(next[id]).arg(seq)
+                      .arg(seq < next[id] ? "duplicated/reordered" : "lost");
+        }
+        next[id] = seq + 1;
+    }
+
+    for (int id = 0; id < threads; ++id) {
+        if (next[id] != count) {
+            errors << QString("thread %1: %2 of %3 records").arg(id).arg(next[id]).arg(count);
+        }
+    }
+
+    return errors;
+}
+
+qint64 TestRotationStress::histogramPercentile(const QVector<int> &histogram, int total, int percent)
+{
+    int seen = 0;
+    for (int bucket = 0; bucket < histogram.size(); ++bucket) {
+        seen += histogram[bucket];
+        if (seen * 100 >= total * percent) {
+            return qint64(1) << bucket;
+        }
+    }
+    return qint64(1) << (histogram.size() - 1);
+}
+
+void TestRotationStress::stress_data()
+{
+    QTest::addColumn<int>("failurePercent");
+    QTest::addColumn<int>("latencyUs");
+
+    QTest::newRow("clean") << 0 << 0;
+    QTest::newRow("failures") << 10 << 0;
+    QTest::newRow("failures and latency") << 10 << 50;
+}
+
+void TestRotationStress::stress()
+{
+    QFETCH(int, failurePercent);
+    QFETCH(int, latencyUs);
+
+    const int threads = 8;
+    const int count = 5000;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    FaultyFileSizeRotationStrategy *strategy =
+            new FaultyFileSizeRotationStrategy(failurePercent, latencyUs, 1);
+    runProducers(strategy, dir.path(), 4096, threads, count);
+
+    const QStringList errors = verifyStream(strategy->stream(), threads, count);
+    QVERIFY2(errors.isEmpty(), qPrintable(errors.mid(0, 10).join('\n')));
+    QVERIFY(strategy->rotations() > 0);
+    if (failurePercent > 0) {
+        QVERIFY(strategy->failures() > 0);
+    }
+}
+
+/*
+ * With the real file hooks, so the production rotation path is measured
+ * and not the in-memory double. Set QAPPLOGGING_ROTATION_MAX_P99_US to fail
+ * on a regression.
+ */
+void TestRotationStress::rotationLatency()
+{
+    const int threads = 4;
+    const int count = 20000;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    TimedFileSizeRotationStrategy *strategy = new TimedFileSizeRotationStrategy();
+    runProducers(strategy, dir.path(), 4096, threads, count);
+
+    const int rotations = strategy->rotations();
+    QVERIFY(rotations > 0);
+
+    const QVector<int> &histogram = strategy->histogram();
+    for (int bucket = 0; bucket < histogram.size(); ++bucket) {
+        if (histogram[bucket]) {
+            qDebug("rotation < %10lld us: %d", qint64(1) << bucket, histogram[bucket]);
+        }
+    }
+    const qint64 p50 = histogramPercentile(histogram, rotations, 50);
+    const qint64 p99 = histogramPercentile(histogram, rotations, 99);
+    qDebug("%d rotations, p50 < %lld us, p99 < %lld us", rotations, p50, p99);
+
+    const QByteArray limit = qgetenv("QAPPLOGGING_ROTATION_MAX_P99_US");
+    if (!limit.isEmpty()) {
+        QVERIFY2(p99 <= limit.toLongLong(),
+                 qPrintable(QString("rotation p99 %1 us over limit %2 us").arg(p99).arg(QString(limit))));
+    }
+}
+
+QTEST_GUILESS_MAIN(TestRotationStress)
+
+#include "tst_rotationstress.moc"
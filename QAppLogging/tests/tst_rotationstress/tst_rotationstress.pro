@@ -0,0 +1,19 @@
+#-------------------------------------------------
+#
+# Concurrent stress and fault injection test for
+# the QAppLogging file rotation path
+#
+#-------------------------------------------------
+
+QT       += core testlib
+QT       -= gui
+
+CONFIG   += console testcase
+CONFIG   -= app_bundle
+
+TARGET = tst_rotationstress
+TEMPLATE = app
+
+include(../../QAppLogging.pri)
+
+SOURCES += tst_rotationstress.cpp
@@ -1,5 +1,94 @@
 #include "AboutDialog.h"
 
+#ifdef ABOUTDIALOG_APPLOGGING
+#include "QAppLogging.h"
+#endif
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+#endif
+
+#define LOGO_PATH               ":images/appIcon_64x64.png"
+#define LOGO_SIZE               64
+#define DIAGNOSTICS_INTERVAL_MS 1000
+#define THREADS_INTERVAL_TICKS  10      // the thread count is costly on Windows
+
+// close enough to the process start for the uptime
+static const qint64 g_startMSecs = QDateTime::currentMSecsSinceEpoch();
+
+QPointer<AboutDialog> AboutDialog::s_instance;
+
+// resident set size in bytes and number of threads, -1 when unknown. On
+// Windows the thread count takes a snapshot of all the processes, it is only
+// done with countThreads set.
+static void processStats(qint64 *rss, int *threads, bool countThreads)
+{
+	Q_UNUSED(countThreads);
+	*rss = -1;
+	*threads = -1;
+#if defined(Q_OS_WIN)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		*rss = qint64(counters.WorkingSetSize);
+	}
+	if (!countThreads) {
+		return;
+	}
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+	if (snapshot != INVALID_HANDLE_VALUE) {
+		PROCESSENTRY32 entry;
+		entry.dwSize = sizeof(entry);
+		const DWORD pid = GetCurrentProcessId();
+		for (BOOL ok = Process32First(snapshot, &entry); ok; ok = Process32Next(snapshot, &entry)) {
+			if (entry.th32ProcessID == pid) {
+				*threads = int(entry.cntThreads);
+				break;
+			}
+		}
+		CloseHandle(snapshot);
+	}
+#elif defined(Q_OS_LINUX)
+	QFile file(QStringLiteral("/proc/self/status"));
+	if (file.open(QIODevice::ReadOnly)) {
+		foreach (const QByteArray &line, file.readAll().split('\n')) {
+			if (line.startsWith("VmRSS:")) {
+				*rss = line.mid(6).trimmed().split(' ').value(0).toLongLong() * 1024;
+			} else if (line.startsWith("Threads:")) {
+				*threads = line.mid(8).trimmed().toInt();
+			}
+		}
+	}
+#endif
+}
+
+/*!
+ * \brief AboutDialog::instance
+ *
+ * The dialog is built on the first call and reused afterwards, it is owned
+ * by the \a parent of the first call.
+ */
+AboutDialog *AboutDialog::instance(QWidget *parent)
+{
+	if (s_instance.isNull()) {
+		s_instance = new AboutDialog(parent);
+	}
+	return s_instance;
+}
+
+// loaded and scaled once, shared by the window icon and the logo label
+QPixmap AboutDialog::logo()
+{
+	QPixmap pixmap;
+	if (!QPixmapCache::find(QStringLiteral(LOGO_PATH), &pixmap)) {
+		pixmap = QPixmap(QStringLiteral(LOGO_PATH)).scaled(LOGO_SIZE, LOGO_SIZE,
+			Qt::KeepAspectRatio, Qt::SmoothTransformation);
+		QPixmapCache::insert(QStringLiteral(LOGO_PATH), pixmap);
+	}
+	return pixmap;
+}
+
 /**
 
 - QGridLayout
@@ -12,10 +101,16 @@
 		- QLable
 	- QGroupBox (Copy Right)
 		- QLable
+	- QGroupBox (Diagnostics, hidden by default)
+		- QLable
 
  */
 AboutDialog::AboutDialog(QWidget *parent) :
-	QDialog(parent)
+	QDialog(parent),
+	m_diagnosticsEnabled(false),
+	m_diagnosticsTicks(0),
+	m_threads(-1),
+	m_lastRecordCount(0)
 {
 	QFont font;
 	font.setPointSize(9);
@@ -26,7 +121,7 @@ AboutDialog::AboutDialog(QWidget *parent) :
 	setWindowModality(Qt::NonModal);
 	resize(400, 300);
 	setWindowTitle(tr("varApplicationName"));
-	setWindowIcon(QIcon(":images/appIcon_64x64.png"));
+	setWindowIcon(QIcon(logo()));
 	m_gridLayout = new QGridLayout(this);
 
 	m_horizontalLayout = new QHBoxLayout();
@@ -36,8 +131,7 @@ AboutDialog::AboutDialog(QWidget *parent) :
 	m_labelLogo->setMinimumSize(QSize(64, 64));
 	m_labelLogo->setMaximumSize(QSize(64, 64));
 	m_labelLogo->setText(QStringLiteral(""));
-	m_labelLogo->setPixmap(QPixmap(QString::fromUtf8(":images/appIcon_64x64.png")));
-	m_labelLogo->setScaledContents(true);
+	m_labelLogo->setPixmap(logo());
 	m_labelLogo->setAlignment(Qt::AlignCenter);
 	m_horizontalLayout->addWidget(m_labelLogo);
 	m_horizontalSpacer2 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
@@ -84,16 +178,101 @@ AboutDialog::AboutDialog(QWidget *parent) :
 	m_gridLayoutOptInfo2->addWidget(m_labelOptInfo2, 0, 0, 1, 1);
 	m_gridLayout->addWidget(m_gbOptInfo2);
 
+	m_gbDiagnostics = new QGroupBox(this);
+	m_gbDiagnostics->setTitle(QStringLiteral("Diagnostics"));
+	m_gbDiagnostics->setAlignment(Qt::AlignCenter);
+	m_gbDiagnostics->setFlat(true);
+	m_gridLayoutDiagnostics = new QGridLayout(m_gbDiagnostics);
+	m_labelDiagnostics = new QLabel(this);
+	m_labelDiagnostics->setAlignment(Qt::AlignHCenter|Qt::AlignTop);
+	m_labelDiagnostics->setTextInteractionFlags(Qt::TextSelectableByMouse);
+	m_gridLayoutDiagnostics->addWidget(m_labelDiagnostics, 0, 0, 1, 1);
+	m_gridLayout->addWidget(m_gbDiagnostics);
+	m_gbDiagnostics->setVisible(false);
+
+	m_diagnosticsTimer = new QTimer(this);
+	m_diagnosticsTimer->setInterval(DIAGNOSTICS_INTERVAL_MS);
+	connect(m_diagnosticsTimer, &QTimer::timeout, this, &AboutDialog::updateDiagnostics);
+
 	//m_gridLayout->setColumnStretch(0, 1);
 	m_gridLayout->setRowStretch(0, 2);
 	m_gridLayout->setRowStretch(1, 1);
 	m_gridLayout->setRowStretch(1, 1);
 	m_gridLayout->setRowStretch(1, 1);
-
-	show();
 }
 
 AboutDialog::~AboutDialog()
 {
 
+}
+
+void AboutDialog::setDiagnosticsEnabled(bool enable)
+{
+	m_diagnosticsEnabled = enable;
+	m_gbDiagnostics->setVisible(enable);
+	if (enable && isVisible()) {
+		updateDiagnostics();
+		m_diagnosticsTimer->start();
+	} else {
+		m_diagnosticsTimer->stop();
+	}
+}
+
+// the diagnostics are only refreshed while the dialog is on screen
+void AboutDialog::showEvent(QShowEvent *event)
+{
+	QDialog::showEvent(event);
+	if (m_diagnosticsEnabled) {
+		updateDiagnostics();
+		m_diagnosticsTimer->start();
+	}
+}
+
+void AboutDialog::hideEvent(QHideEvent *event)
+{
+	m_diagnosticsTimer->stop();
+	m_diagnosticsClock.invalidate();
+	m_diagnosticsTicks = 0;
+	QDialog::hideEvent(event);
+}
+
+void AboutDialog::updateDiagnostics()
+{
+	qint64 rss;
+	int threads;
+	processStats(&rss, &threads, m_diagnosticsTicks++ % THREADS_INTERVAL_TICKS == 0);
+	if (threads < 0) {
+		threads = m_threads;
+	}
+	m_threads = threads;
+
+	const qint64 uptime = (QDateTime::currentMSecsSinceEpoch() - g_startMSecs) / 1000;
+	QString text = tr("Uptime: %1d %2:%3:%4")
+		.arg(uptime / 86400)
+		.arg((uptime / 3600) % 24, 2, 10, QLatin1Char('0'))
+		.arg((uptime / 60) % 60, 2, 10, QLatin1Char('0'))
+		.arg(uptime % 60, 2, 10, QLatin1Char('0'));
+	text += QStringLiteral("\n");
+	text += tr("Memory (RSS): %1").arg(rss < 0 ? tr("n/a") : QString("%1 MB").arg(rss / 1048576.0, 0, 'f', 1));
+	text += QStringLiteral("\n");
+	text += tr("Threads: %1").arg(threads < 0 ? tr("n/a") : QString::number(threads));
+
+#ifdef ABOUTDIALOG_APPLOGGING
+	QAppLogging *appLogging = QAppLogging::instance();
+	const quint64 records = appLogging->recordCount();
+	const qint64 elapsed = m_diagnosticsClock.isValid() ? m_diagnosticsClock.restart() : 0;
+	if (!m_diagnosticsClock.isValid()) {
+		m_diagnosticsClock.start();
+	}
+	const double rate = elapsed > 0 ? (records - m_lastRecordCount) * 1000.0 / elapsed : 0.0;
+	m_lastRecordCount = records;
+	text += QStringLiteral("\n");
+	text += tr("Log: %1 records, %2/s, %3 file failures, %4 ring drops")
+		.arg(records)
+		.arg(rate, 0, 'f', 1)
+		.arg(appLogging->fileFailedCount())
+		.arg(appLogging->ringDroppedCount());
+#endif
+
+	m_labelDiagnostics->setText(text);
 }
\ No newline at end of file
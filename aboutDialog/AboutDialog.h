@@ -9,16 +9,30 @@ class AboutDialog : public QDialog
     Q_OBJECT
 
 public:
-    explicit AboutDialog(QWidget *parent = 0);
+    static AboutDialog *instance(QWidget *parent = 0);
     ~AboutDialog();
 
+    void setDiagnosticsEnabled(bool enable);
+    bool diagnosticsEnabled() const {return m_diagnosticsEnabled;}
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    void updateDiagnostics();
+
 private:
+    explicit AboutDialog(QWidget *parent = 0);
+    static QPixmap logo();
+
+    static QPointer<AboutDialog> s_instance;
+
 	QGridLayout *m_gridLayout;
 	QHBoxLayout *m_horizontalLayout;
 
 	QSpacerItem *m_horizontalSpacer1;
 	QLabel *m_labelLogo;
-	QPixmap *m_logo;
 	QSpacerItem *m_horizontalSpacer2;
 	QLabel *m_labelBasicInfo;
 	QGroupBox *m_gbOptInfo1;
@@ -27,6 +41,16 @@ private:
 	QGroupBox *m_gbOptInfo2;
 	QGridLayout *m_gridLayoutOptInfo2;
 	QLabel *m_labelOptInfo2;
+	QGroupBox *m_gbDiagnostics;
+	QGridLayout *m_gridLayoutDiagnostics;
+	QLabel *m_labelDiagnostics;
+
+	bool m_diagnosticsEnabled;
+	QTimer *m_diagnosticsTimer;
+	int m_diagnosticsTicks;
+	int m_threads;                  // last known, not refreshed every tick
+	QElapsedTimer m_diagnosticsClock;
+	quint64 m_lastRecordCount;
 };
 
 #endif // ABOUTDIALOG_H
\ No newline at end of file
@@ -23,3 +23,9 @@ FORMS    += mainwindow.ui
 
 RESOURCES += \
     images.qrc
+
+win32: LIBS += -lpsapi
+
+# show the QAppLogging throughput and drops in the diagnostics section
+include(../QAppLogging/QAppLogging.pri)
+DEFINES += ABOUTDIALOG_APPLOGGING
@@ -1,9 +1,17 @@
 #include "mainwindow.h"
 #include <QApplication>
 
+#ifdef ABOUTDIALOG_APPLOGGING
+#include "QAppLogging.h"
+#endif
+
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+#ifdef ABOUTDIALOG_APPLOGGING
+    // feeds the log counters of the diagnostics
+    QAppLogging::installHandler();
+#endif
     MainWindow w;
     w.show();
 
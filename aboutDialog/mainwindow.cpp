@@ -15,7 +15,9 @@ MainWindow::~MainWindow()
 
 void MainWindow::on_actionAbout_triggered()
 {
-	m_aboutDialog = new AboutDialog(this);
-
-	m_aboutDialog->show();
+	AboutDialog *aboutDialog = AboutDialog::instance(this);
+	aboutDialog->setDiagnosticsEnabled(true);
+	aboutDialog->show();
+	aboutDialog->raise();
+	aboutDialog->activateWindow();
 }
@@ -22,7 +22,6 @@ private slots:
 
 private:
     Ui::MainWindow *ui;
-    AboutDialog *m_aboutDialog;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,129 @@
+#include "LogViewer.h"
+
+#define FILTER_DELAY_MS         300
+
+/**
+
+- QVBoxLayout
+	- QHBoxLayout
+		- QPushButton (Open)
+		- QComboBox (Level)
+		- QLineEdit (Source)
+		- QLineEdit (Regex)
+		- QCheckBox (Follow)
+		- QLabel (Status)
+	- QListView
+
+ */
+LogViewer::LogViewer(QWidget *parent) :
+	QWidget(parent)
+{
+	resize(1000, 600);
+	setWindowTitle(tr("Log Viewer"));
+
+	m_model = new LogViewerModel(this);
+
+	m_verticalLayout = new QVBoxLayout(this);
+	m_horizontalLayout = new QHBoxLayout();
+
+	m_pbOpen = new QPushButton(tr("Open..."), this);
+	m_horizontalLayout->addWidget(m_pbOpen);
+
+	m_cbLevel = new QComboBox(this);
+	m_cbLevel->addItems(QStringList() << tr("Debug") << tr("Info") << tr("Warning") << tr("Critical") << tr("Fatal"));
+	m_horizontalLayout->addWidget(m_cbLevel);
+
+	m_leSource = new QLineEdit(this);
+	m_leSource->setPlaceholderText(tr("Source"));
+	m_horizontalLayout->addWidget(m_leSource);
+
+	m_leRegex = new QLineEdit(this);
+	m_leRegex->setPlaceholderText(tr("Regular expression"));
+	m_horizontalLayout->addWidget(m_leRegex, 1);
+
+	m_chkFollow = new QCheckBox(tr("Follow"), this);
+	m_horizontalLayout->addWidget(m_chkFollow);
+
+	m_labelStatus = new QLabel(this);
+	m_horizontalLayout->addWidget(m_labelStatus);
+	m_verticalLayout->addLayout(m_horizontalLayout);
+
+	// uniform item sizes keep the view from asking the model for every row
+	m_listView = new QListView(this);
+	m_listView->setUniformItemSizes(true);
+	m_listView->setLayoutMode(QListView::Batched);
+	m_listView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+	m_listView->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+	m_listView->setModel(m_model);
+	m_verticalLayout->addWidget(m_listView);
+
+	m_filterTimer = new QTimer(this);
+	m_filterTimer->setSingleShot(true);
+	m_filterTimer->setInterval(FILTER_DELAY_MS);
+
+	connect(m_pbOpen, &QPushButton::clicked, this, &LogViewer::onOpenClicked);
+	connect(m_cbLevel, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+			this, &LogViewer::applyFilter);
+	connect(m_leSource, &QLineEdit::textChanged, m_filterTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+	connect(m_leRegex, &QLineEdit::textChanged, m_filterTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+	connect(m_filterTimer, &QTimer::timeout, this, &LogViewer::applyFilter);
+	connect(m_chkFollow, &QCheckBox::toggled, m_model, &LogViewerModel::setFollow);
+	connect(m_model, &LogViewerModel::progressChanged, this, &LogViewer::updateStatus);
+	connect(m_model, &LogViewerModel::rowsInserted, this, &LogViewer::onRowsInserted);
+}
+
+LogViewer::~LogViewer()
+{
+
+}
+
+bool LogViewer::openLogFile(const QString &filePath)
+{
+	const bool ret = m_model->openLogFile(filePath);
+	setWindowTitle(tr("Log Viewer - %1").arg(QFileInfo(filePath).fileName()));
+	applyFilter();
+	return ret;
+}
+
+void LogViewer::onOpenClicked()
+{
+	const QString filePath = QFileDialog::getOpenFileName(this, tr("Open Log File"), m_model->filePath());
+	if (!filePath.isEmpty()) {
+		openLogFile(filePath);
+	}
+}
+
+void LogViewer::applyFilter()
+{
+	LogFilter filter;
+	filter.minLevel = m_cbLevel->currentIndex();
+	filter.source = m_leSource->text().toUtf8();
+	filter.regex.setPattern(m_leRegex->text());
+
+	if (!filter.regex.isValid()) {
+		m_leRegex->setStyleSheet(QStringLiteral("color:red"));
+		return;
+	}
+	m_leRegex->setStyleSheet(QString());
+
+	m_model->setFilter(filter);
+}
+
+void LogViewer::updateStatus()
+{
+	m_labelStatus->setText(tr("%1 of %2 lines%3")
+		.arg(m_model->rowCount())
+		.arg(m_model->lineCount())
+		.arg(m_model->isBusy() ? tr(", working...") : QString()));
+}
+
+// keep the last line visible when following and already at the bottom
+void LogViewer::onRowsInserted()
+{
+	updateStatus();
+
+	QScrollBar *scrollBar = m_listView->verticalScrollBar();
+	if (m_chkFollow->isChecked() && scrollBar->value() == scrollBar->maximum()) {
+		QTimer::singleShot(0, m_listView, &QListView::scrollToBottom);
+	}
+}
@@ -0,0 +1,41 @@
+#ifndef LOGVIEWER_H
+#define LOGVIEWER_H
+
+#include <QWidget>
+#include <QtWidgets>
+
+#include "LogViewerModel.h"
+
+class LogViewer : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit LogViewer(QWidget *parent = 0);
+    ~LogViewer();
+
+    bool openLogFile(const QString &filePath);
+    LogViewerModel *model() const {return m_model;}
+
+private slots:
+    void onOpenClicked();
+    void applyFilter();
+    void updateStatus();
+    void onRowsInserted();
+
+private:
+    LogViewerModel *m_model;
+
+    QVBoxLayout *m_verticalLayout;
+    QHBoxLayout *m_horizontalLayout;
+    QPushButton *m_pbOpen;
+    QComboBox *m_cbLevel;
+    QLineEdit *m_leSource;
+    QLineEdit *m_leRegex;
+    QCheckBox *m_chkFollow;
+    QLabel *m_labelStatus;
+    QListView *m_listView;
+    QTimer *m_filterTimer;
+};
+
+#endif // LOGVIEWER_H
@@ -0,0 +1,890 @@
+#include "LogViewerModel.h"
+
+#include <QFile>
+#include <QDir>
+#include <QColor>
+#include <QDebug>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <string.h>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <stdio.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#define LOG_CHECKPOINT_STRIDE   64
+#define LOG_CHUNK_SIZE          (32*1024*1024)
+#define LOG_FILTER_BLOCK        16384
+#define LOG_FOLLOW_INTERVAL     500
+#define LOG_MAX_LIVE_MAPPINGS   32
+#define LOG_RANK_STRIDE         512
+#define LOG_BACKUP_SCAN_GAP     2
+
+/**
+
+The rotated set of "name.txt" is name.txt.N ... name.txt.1 name.txt, oldest
+first, as written by FileSizeRotationStrategy.
+
+Every file is memory mapped and cut into chunks of at most LOG_CHUNK_SIZE
+bytes ending on a line break. A chunk only keeps the offset of every
+LOG_CHECKPOINT_STRIDE-th line, a line is found by scanning forward from its
+checkpoint, so the index stays small however big the files are.
+
+Chunks are indexed one after the other on a worker thread and appended to
+the model when done. Filtering splits the lines in blocks which run on the
+global thread pool, the results are appended in block order. Both jobs work
+on a copy of the chunk list, mappings are never moved while a job runs.
+
+When following, the growth of the live file is mapped as a new region, the
+regions are merged back into one mapping when the jobs are idle. A rotation
+is detected by the identity (inode, file index) of the path changing, the
+old live file becomes the newest backup, backups rotated in between are
+picked up by identity and only the new files are mapped. Segments whose
+identity is no longer among the backups have been deleted by the logger,
+they are closed and their rows removed when the jobs are idle.
+
+On Windows QFile keeps one file mapping object, sized at the first map(),
+until all its views are unmapped. Regions mapped later than the first one
+of a segment go through a duplicate of its handle.
+
+A filter keeps one bit per line plus a match count every LOG_RANK_STRIDE
+lines to find the line of a row.
+
+ */
+
+#ifdef Q_OS_WIN
+// takes the ownership of handle
+static QFile *fileFromHandle(HANDLE handle)
+{
+    const int fd = _open_osfhandle(reinterpret_cast<intptr_t>(handle), _O_RDONLY);
+    if (fd < 0) {
+        CloseHandle(handle);
+        return nullptr;
+    }
+    // QFile maps FILE* opened files through their native handle
+    FILE *fh = _fdopen(fd, "rb");
+    if (!fh) {
+        _close(fd);
+        return nullptr;
+    }
+    QFile *file = new QFile();
+    if (!file->open(fh, QIODevice::ReadOnly, QFileDevice::AutoCloseHandle)) {
+        fclose(fh);
+        delete file;
+        return nullptr;
+    }
+    return file;
+}
+#endif
+
+/*
+ * On Windows the files are opened with FILE_SHARE_DELETE, otherwise the
+ * logger could not rename the live file while it is viewed.
+ */
+static QFile *openSegmentFile(const QString &path)
+{
+#ifdef Q_OS_WIN
+    HANDLE handle = CreateFileW(reinterpret_cast<const wchar_t *>(QDir::toNativeSeparators(path).utf16()),
+                                GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    return fileFromHandle(handle);
+#else
+    QFile *file = new QFile(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        delete file;
+        return nullptr;
+    }
+    return file;
+#endif
+}
+
+// the file to map a further region of an already mapped segment from
+static QFile *mappingFile(QFile *segmentFile)
+{
+#ifdef Q_OS_WIN
+    HANDLE handle = INVALID_HANDLE_VALUE;
+    if (!DuplicateHandle(GetCurrentProcess(), reinterpret_cast<HANDLE>(_get_osfhandle(segmentFile->handle())),
+                         GetCurrentProcess(), &handle, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+        return nullptr;
+    }
+    return fileFromHandle(handle);
+#else
+    return segmentFile;
+#endif
+}
+
+#ifdef Q_OS_WIN
+static QByteArray handleIdentity(HANDLE handle)
+{
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle(handle, &info)) {
+        return QByteArray();
+    }
+    return QByteArray::number(quint64(info.dwVolumeSerialNumber)) + ':'
+            + QByteArray::number((quint64(info.nFileIndexHigh) << 32) | info.nFileIndexLow);
+}
+#else
+static QByteArray statIdentity(const struct stat &st)
+{
+    return QByteArray::number(quint64(st.st_dev)) + ':' + QByteArray::number(quint64(st.st_ino));
+}
+#endif
+
+// identity of an open file, stays the same when it is renamed
+static QByteArray fileIdentity(QFile *file)
+{
+#ifdef Q_OS_WIN
+    return handleIdentity(reinterpret_cast<HANDLE>(_get_osfhandle(file->handle())));
+#else
+    struct stat st;
+    if (fstat(file->handle(), &st) != 0) {
+        return QByteArray();
+    }
+    return statIdentity(st);
+#endif
+}
+
+// identity of the file currently at path, empty when there is none
+static QByteArray pathIdentity(const QString &path)
+{
+#ifdef Q_OS_WIN
+    HANDLE handle = CreateFileW(reinterpret_cast<const wchar_t *>(QDir::toNativeSeparators(path).utf16()),
+                                0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return QByteArray();
+    }
+    const QByteArray identity = handleIdentity(handle);
+    CloseHandle(handle);
+    return identity;
+#else
+    struct stat st;
+    if (stat(QFile::encodeName(path).constData(), &st) != 0) {
+        return QByteArray();
+    }
+    return statIdentity(st);
+#endif
+}
+
+static int chunkForLine(const QVector<LogChunk> &chunks, int line)
+{
+    QVector<LogChunk>::const_iterator it = std::upper_bound(chunks.constBegin(), chunks.constEnd(), line,
+        [](int l, const LogChunk &chunk) { return l < chunk.firstLine; });
+    return int(it - chunks.constBegin()) - 1;
+}
+
+static qint64 nextLine(const LogChunk &chunk, qint64 offset)
+{
+    const void *nl = memchr(chunk.data + offset, '\n', size_t(chunk.size - offset));
+    return nl ? static_cast<const char *>(nl) - chunk.data + 1 : chunk.size;
+}
+
+static qint64 lineOffset(const LogChunk &chunk, int line)
+{
+    const int n = line - chunk.firstLine;
+    qint64 offset = chunk.checkpoints.at(n / LOG_CHECKPOINT_STRIDE);
+    for (int i = n % LOG_CHECKPOINT_STRIDE; i > 0; --i) {
+        offset = nextLine(chunk, offset);
+    }
+    return offset;
+}
+
+static int lineLength(const LogChunk &chunk, qint64 offset)
+{
+    qint64 end = nextLine(chunk, offset);
+    if (end > offset && chunk.data[end - 1] == '\n') {
+        --end;
+    }
+    if (end > offset && chunk.data[end - 1] == '\r') {
+        --end;
+    }
+    return int(end - offset);
+}
+
+static LogChunk indexChunk(LogChunk chunk)
+{
+    qint64 offset = 0;
+    int lines = 0;
+    while (offset < chunk.size) {
+        if (lines % LOG_CHECKPOINT_STRIDE == 0) {
+            chunk.checkpoints.append(offset);
+        }
+        offset = nextLine(chunk, offset);
+        ++lines;
+    }
+    chunk.lineCount = lines;
+    return chunk;
+}
+
+static bool matchFilter(const LogFilter &filter, const char *line, int length)
+{
+    if (filter.minLevel > 0 && LogViewerModel::lineLevel(line, length) < filter.minLevel) {
+        return false;
+    }
+
+    if (!filter.source.isEmpty()) {
+        // "[time L] file:line - message", the source is between "] " and " - "
+        const QByteArray text = QByteArray::fromRawData(line, length);
+        const int begin = text.indexOf("] ");
+        const int end = text.indexOf(" - ", begin);
+        if (begin < 0 || end < 0 || text.mid(begin, end - begin).indexOf(filter.source) < 0) {
+            return false;
+        }
+    }
+
+    if (!filter.regex.pattern().isEmpty()
+            && !filter.regex.match(QString::fromUtf8(line, length)).hasMatch()) {
+        return false;
+    }
+
+    return true;
+}
+
+struct FilterBlock {
+    int from;
+    int to;
+};
+
+struct FilterFunctor {
+    typedef QVector<int> result_type;
+
+    FilterFunctor(const QVector<LogChunk> &c, const LogFilter &f) : chunks(c), filter(f) {}
+
+    QVector<int> operator()(const FilterBlock &block) const
+    {
+        QVector<int> matches;
+        int index = chunkForLine(chunks, block.from);
+        qint64 offset = lineOffset(chunks.at(index), block.from);
+        for (int line = block.from; line < block.to; ++line) {
+            const LogChunk *chunk = &chunks.at(index);
+            if (line >= chunk->firstLine + chunk->lineCount) {
+                chunk = &chunks.at(++index);
+                offset = 0;
+            }
+            if (matchFilter(filter, chunk->data + offset, lineLength(*chunk, offset))) {
+                matches.append(line);
+            }
+            offset = nextLine(*chunk, offset);
+        }
+        return matches;
+    }
+
+    QVector<LogChunk> chunks;
+    LogFilter filter;
+};
+
+LogViewerModel::LogViewerModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_liveEnd(0)
+    , m_lineCount(0)
+    , m_filteredRows(0)
+    , m_filteredUpTo(0)
+    , m_filterJobTo(0)
+    , m_nextFilterBlock(0)
+{
+    connect(&m_indexWatcher, &QFutureWatcher<LogChunk>::finished, this, &LogViewerModel::onIndexFinished);
+    connect(&m_filterWatcher, &QFutureWatcher<QVector<int> >::resultReadyAt, this, &LogViewerModel::onFilterResultReady);
+    connect(&m_filterWatcher, &QFutureWatcher<QVector<int> >::finished, this, &LogViewerModel::onFilterFinished);
+    connect(&m_followTimer, &QTimer::timeout, this, &LogViewerModel::onFollowTimeout);
+    m_followTimer.setInterval(LOG_FOLLOW_INTERVAL);
+}
+
+LogViewerModel::~LogViewerModel()
+{
+    close();
+}
+
+bool LogViewerModel::openLogFile(const QString &filePath)
+{
+    close();
+
+    QStringList paths;
+    for (int i = 1; QFile::exists(filePath + QString(".%1").arg(i)); ++i) {
+        paths.prepend(filePath + QString(".%1").arg(i));
+    }
+    paths.append(filePath);
+
+    beginResetModel();
+    m_filePath = filePath;
+    foreach (const QString &path, paths) {
+        appendSegment(path, path == filePath);
+    }
+    endResetModel();
+
+    if (m_paths.isEmpty() || m_paths.last() != filePath) {
+        return false;
+    }
+
+    startIndexing();
+    return true;
+}
+
+/*!
+ * \brief LogViewerModel::appendSegment
+ *
+ * Open \a path as the newest segment and queue it for indexing. Only the
+ * complete lines of the \a live file are taken, the rest comes when
+ * following.
+ */
+bool LogViewerModel::appendSegment(const QString &path, bool live)
+{
+    QFile *file = openSegmentFile(path);
+    if (!file) {
+        return false;
+    }
+    m_files.append(file);
+    m_paths.append(path);
+    m_identities.append(fileIdentity(file));
+
+    const qint64 consumed = mapSegment(m_files.size() - 1, 0, file->size(), !live);
+    if (live) {
+        m_liveEnd = consumed;
+    }
+    return true;
+}
+
+/*!
+ * \brief LogViewerModel::backupIdentities
+ *
+ * \return the identities of name.1, name.2 ..., empty for a missing one. The
+ * logger renames the backups one by one, so a single gap is skipped.
+ */
+QList<QByteArray> LogViewerModel::backupIdentities() const
+{
+    QList<QByteArray> identities;
+    int missing = 0;
+    for (int i = 1; missing < LOG_BACKUP_SCAN_GAP; ++i) {
+        const QByteArray identity = pathIdentity(m_filePath + QString(".%1").arg(i));
+        identities.append(identity);
+        missing = identity.isEmpty() ? missing + 1 : 0;
+    }
+    while (!identities.isEmpty() && identities.last().isEmpty()) {
+        identities.removeLast();
+    }
+    return identities;
+}
+
+// After a rotation: the backups newer than the old live file have been
+// rotated in between two polls, append them oldest first.
+void LogViewerModel::appendMissedBackups()
+{
+    const QList<QByteArray> backups = backupIdentities();
+    int newer = backups.indexOf(m_identities.last());
+    if (newer < 0) {
+        // the old live file is gone already, all backups are newer
+        newer = backups.size();
+    }
+    for (int i = newer - 1; i >= 0; --i) {
+        if (!backups.at(i).isEmpty() && !m_identities.contains(backups.at(i))) {
+            appendSegment(m_filePath + QString(".%1").arg(i + 1), false);
+        }
+    }
+}
+
+// Close the oldest segments deleted by the logger, only when no job holds
+// chunk pointers or line numbers.
+void LogViewerModel::dropStaleSegments()
+{
+    if (m_files.size() < 2) {
+        return;
+    }
+
+    const QList<QByteArray> backups = backupIdentities();
+    int stale = 0;
+    while (stale < m_files.size() - 1 && !backups.contains(m_identities.at(stale))) {
+        ++stale;
+    }
+    if (stale > 0) {
+        removeSegments(stale);
+    }
+}
+
+// Remove the \a count oldest segments and their rows.
+void LogViewerModel::removeSegments(int count)
+{
+    int chunks = 0;
+    while (chunks < m_chunks.size() && m_chunks.at(chunks).segment < count) {
+        ++chunks;
+    }
+    const int lines = chunks < m_chunks.size() ? m_chunks.at(chunks).firstLine : m_lineCount;
+
+    // the matches behind the removed lines, shifted
+    QVector<int> matches;
+    int removedMatches = 0;
+    for (int word = 0; word < m_filterBits.size(); ++word) {
+        quint64 bits = m_filterBits.at(word);
+        while (bits) {
+            const int line = word * 64 + int(qCountTrailingZeroBits(bits));
+            bits &= bits - 1;
+            if (line < lines) {
+                ++removedMatches;
+            } else {
+                matches.append(line - lines);
+            }
+        }
+    }
+
+    const int removedRows = m_filter.isNull() ? lines : removedMatches;
+    if (removedRows > 0) {
+        beginRemoveRows(QModelIndex(), 0, removedRows - 1);
+    }
+
+    for (int i = m_mappings.size() - 1; i >= 0; --i) {
+        if (m_mappings.at(i).segment < count) {
+            releaseMapping(m_mappings.takeAt(i));
+        } else {
+            m_mappings[i].segment -= count;
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        delete m_files.takeFirst();
+        m_paths.removeFirst();
+        m_identities.removeFirst();
+    }
+
+    m_chunks.remove(0, chunks);
+    for (int i = 0; i < m_chunks.size(); ++i) {
+        m_chunks[i].segment -= count;
+        m_chunks[i].firstLine -= lines;
+    }
+    m_lineCount -= lines;
+
+    m_filterBits.clear();
+    m_filterRank.clear();
+    m_filteredRows = 0;
+    foreach (int line, matches) {
+        markFilterMatch(line);
+    }
+    m_filteredUpTo = qMax(m_filteredUpTo - lines, 0);
+    m_filterJobTo = m_filteredUpTo;
+
+    if (removedRows > 0) {
+        endRemoveRows();
+    }
+    emit progressChanged();
+}
+
+void LogViewerModel::close()
+{
+    m_indexWatcher.cancel();
+    m_indexWatcher.waitForFinished();
+    m_filterWatcher.cancel();
+    m_filterWatcher.waitForFinished();
+
+    beginResetModel();
+    foreach (const Mapping &mapping, m_mappings) {
+        releaseMapping(mapping);
+    }
+    m_mappings.clear();
+    qDeleteAll(m_files);
+    m_files.clear();
+    m_paths.clear();
+    m_identities.clear();
+    m_chunks.clear();
+    m_pendingChunks.clear();
+    m_lineCount = 0;
+    m_liveEnd = 0;
+    m_filterBits.clear();
+    m_filterRank.clear();
+    m_filteredRows = 0;
+    m_filteredUpTo = 0;
+    m_filterResults.clear();
+    endResetModel();
+}
+
+void LogViewerModel::setFilter(const LogFilter &filter)
+{
+    m_filterWatcher.cancel();
+    m_filterWatcher.waitForFinished();
+
+    beginResetModel();
+    m_filter = filter;
+    m_filter.regex.optimize();
+    m_filterBits.clear();
+    m_filterRank.clear();
+    m_filteredRows = 0;
+    m_filteredUpTo = 0;
+    m_filterResults.clear();
+    endResetModel();
+
+    startFiltering();
+    emit progressChanged();
+}
+
+void LogViewerModel::setFollow(bool enable)
+{
+    if (enable) {
+        m_followTimer.start();
+    } else {
+        m_followTimer.stop();
+    }
+}
+
+bool LogViewerModel::isBusy() const
+{
+    return m_indexWatcher.isRunning() || m_filterWatcher.isRunning() || !m_pendingChunks.isEmpty();
+}
+
+int LogViewerModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_filter.isNull() ? m_lineCount : m_filteredRows;
+}
+
+QVariant LogViewerModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) {
+        return QVariant();
+    }
+    if (role != Qt::DisplayRole && role != Qt::ForegroundRole) {
+        return QVariant();
+    }
+
+    const int line = m_filter.isNull() ? index.row() : filteredLine(index.row());
+    if (line < 0) {
+        return QVariant();
+    }
+    const LogChunk &chunk = m_chunks.at(chunkForLine(m_chunks, line));
+    const qint64 offset = lineOffset(chunk, line);
+    const int length = lineLength(chunk, offset);
+
+    if (role == Qt::ForegroundRole) {
+        switch (lineLevel(chunk.data + offset, length)) {
+        case WarnLevel:
+            return QColor(Qt::darkYellow);
+        case CriticalLevel:
+        case FatalLevel:
+            return QColor(Qt::red);
+        default:
+            return QVariant();
+        }
+    }
+
+    return QString::fromUtf8(chunk.data + offset, length);
+}
+
+/*!
+ * \brief LogViewerModel::lineLevel
+ *
+ * Find the level letter of "[yyyyMMdd h:mm:ss.zzz L]" as set by
+ * QAppLogging::installHandler(). The logCollector "[pid] " prefix is skipped.
+ *
+ * \return the level, -1 for lines without one (e.g. multi-line messages)
+ */
+int LogViewerModel::lineLevel(const char *line, int length)
+{
+    static const char levels[] = "DIWCF";
+
+    const int limit = qMin(length, 64);
+    for (int i = 2; i < limit; ++i) {
+        if (line[i] == ']' && line[i - 2] == ' ') {
+            const char *level = strchr(levels, line[i - 1]);
+            if (level && *level) {
+                return int(level - levels);
+            }
+        }
+    }
+    return -1;
+}
+
+void LogViewerModel::onIndexFinished()
+{
+    if (m_indexWatcher.isCanceled() || m_pendingChunks.isEmpty()) {
+        return;
+    }
+
+    LogChunk chunk = m_indexWatcher.result();
+    m_pendingChunks.dequeue();
+    chunk.firstLine = m_lineCount;
+
+    if (m_filter.isNull() && chunk.lineCount > 0) {
+        beginInsertRows(QModelIndex(), m_lineCount, m_lineCount + chunk.lineCount - 1);
+    }
+    m_chunks.append(chunk);
+    m_lineCount += chunk.lineCount;
+    if (m_filter.isNull() && chunk.lineCount > 0) {
+        endInsertRows();
+    }
+
+    startIndexing();
+    startFiltering();
+    emit progressChanged();
+}
+
+void LogViewerModel::onFilterResultReady(int index)
+{
+    m_filterResults.insert(index, m_filterWatcher.resultAt(index));
+
+    while (m_filterResults.contains(m_nextFilterBlock)) {
+        appendFilterMatches(m_filterResults.take(m_nextFilterBlock++));
+    }
+}
+
+// matches come in increasing line order
+void LogViewerModel::appendFilterMatches(const QVector<int> &matches)
+{
+    if (matches.isEmpty()) {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), m_filteredRows, m_filteredRows + matches.size() - 1);
+    foreach (int line, matches) {
+        markFilterMatch(line);
+    }
+    endInsertRows();
+}
+
+// line must be behind all the matches so far
+void LogViewerModel::markFilterMatch(int line)
+{
+    while (m_filterRank.size() <= line / LOG_RANK_STRIDE) {
+        m_filterRank.append(m_filteredRows);
+    }
+    if (m_filterBits.size() <= line / 64) {
+        m_filterBits.resize(line / 64 + 1);
+    }
+    m_filterBits[line / 64] |= quint64(1) << (line % 64);
+    ++m_filteredRows;
+}
+
+int LogViewerModel::filteredLine(int row) const
+{
+    const int group = int(std::upper_bound(m_filterRank.constBegin(), m_filterRank.constEnd(), row)
+                          - m_filterRank.constBegin()) - 1;
+    if (group < 0) {
+        return -1;
+    }
+
+    int remaining = row - m_filterRank.at(group);
+    for (int word = group * (LOG_RANK_STRIDE / 64); word < m_filterBits.size(); ++word) {
+        quint64 bits = m_filterBits.at(word);
+        const int count = int(qPopulationCount(bits));
+        if (remaining < count) {
+            while (remaining-- > 0) {
+                bits &= bits - 1;
+            }
+            return word * 64 + int(qCountTrailingZeroBits(bits));
+        }
+        remaining -= count;
+    }
+    return -1;
+}
+
+void LogViewerModel::onFilterFinished()
+{
+    if (m_filterWatcher.isCanceled()) {
+        return;
+    }
+
+    m_filteredUpTo = m_filterJobTo;
+    startFiltering();
+    emit progressChanged();
+}
+
+void LogViewerModel::onFollowTimeout()
+{
+    if (m_filePath.isEmpty()) {
+        return;
+    }
+
+    const QByteArray identity = pathIdentity(m_filePath);
+    if (identity.isEmpty()) {
+        // in the middle of a rotation
+        return;
+    }
+    if (m_paths.isEmpty() || m_paths.last() != m_filePath) {
+        // the live file did not exist yet when opening
+        appendSegment(m_filePath, true);
+        startIndexing();
+        return;
+    }
+    if (identity != m_identities.last()) {
+        // the live file has been rotated, take the rest of it as the newest
+        // backup and follow the new one, the model is only appended to
+        const int old = m_files.size() - 1;
+        m_liveEnd += mapSegment(old, m_liveEnd, m_files.at(old)->size(), true);
+        appendMissedBackups();
+        appendSegment(m_filePath, true);
+        startIndexing();
+        return;
+    }
+
+    if (!isBusy()) {
+        dropStaleSegments();
+        mergeLiveMappings();
+    }
+
+    const int live = m_files.size() - 1;
+    const qint64 size = m_files.at(live)->size();
+    if (size > m_liveEnd) {
+        m_liveEnd += mapSegment(live, m_liveEnd, size, false);
+        startIndexing();
+    }
+}
+
+/*!
+ * \brief LogViewerModel::mapSegment
+ *
+ * Map [from, to) of a segment file and queue its chunks for indexing. The
+ * trailing partial line is left out unless \a includeTail is set.
+ *
+ * \return the number of bytes queued
+ */
+qint64 LogViewerModel::mapSegment(int segment, qint64 from, qint64 to, bool includeTail)
+{
+    if (to <= from) {
+        return 0;
+    }
+
+    QFile *segmentFile = m_files.at(segment);
+    QFile *file = from > 0 ? mappingFile(segmentFile) : segmentFile;
+    if (!file) {
+        qWarning() << "LogViewer: could not duplicate" << m_paths.at(segment);
+        return 0;
+    }
+    uchar *base = file->map(from, to - from);
+    if (!base) {
+        qWarning() << "LogViewer: could not map" << m_paths.at(segment) << file->errorString();
+        if (file != segmentFile) {
+            delete file;
+        }
+        return 0;
+    }
+    const char *data = reinterpret_cast<const char *>(base);
+    const qint64 total = to - from;
+
+    qint64 pos = 0;
+    while (pos < total) {
+        qint64 end = qMin(pos + LOG_CHUNK_SIZE, total);
+        if (end < total || !includeTail) {
+            qint64 nl = end;
+            while (nl > pos && data[nl - 1] != '\n') {
+                --nl;
+            }
+            if (nl == pos) {
+                // a line longer than a chunk
+                const void *next = memchr(data + end, '\n', size_t(total - end));
+                nl = next ? static_cast<const char *>(next) - data + 1 : (includeTail ? total : pos);
+            }
+            end = nl;
+        }
+        if (end == pos) {
+            break;
+        }
+
+        LogChunk chunk;
+        chunk.segment = segment;
+        chunk.data = data + pos;
+        chunk.fileOffset = from + pos;
+        chunk.size = end - pos;
+        chunk.firstLine = 0;
+        chunk.lineCount = 0;
+        m_pendingChunks.enqueue(chunk);
+        pos = end;
+    }
+
+    Mapping mapping;
+    mapping.segment = segment;
+    mapping.fileOffset = from;
+    mapping.base = base;
+    mapping.file = file;
+    if (pos == 0) {
+        releaseMapping(mapping);
+        return 0;
+    }
+
+    m_mappings.append(mapping);
+    return pos;
+}
+
+void LogViewerModel::releaseMapping(const Mapping &mapping)
+{
+    mapping.file->unmap(mapping.base);
+    if (mapping.file != m_files.at(mapping.segment)) {
+        delete mapping.file;
+    }
+}
+
+// Replace the regions mapped while following the live file with one mapping,
+// only called when no job holds chunk pointers.
+void LogViewerModel::mergeLiveMappings()
+{
+    const int live = m_files.size() - 1;
+    int first = m_mappings.size();
+    while (first > 0 && m_mappings.at(first - 1).segment == live) {
+        --first;
+    }
+    if (m_mappings.size() - first <= LOG_MAX_LIVE_MAPPINGS) {
+        return;
+    }
+
+    QFile *file = mappingFile(m_files.at(live));
+    if (!file) {
+        return;
+    }
+    const qint64 from = m_mappings.at(first).fileOffset;
+    uchar *base = file->map(from, m_liveEnd - from);
+    if (!base) {
+        if (file != m_files.at(live)) {
+            delete file;
+        }
+        return;
+    }
+
+    for (int i = m_chunks.size() - 1; i >= 0 && m_chunks.at(i).segment == live; --i) {
+        LogChunk &chunk = m_chunks[i];
+        if (chunk.fileOffset < from) {
+            break;
+        }
+        chunk.data = reinterpret_cast<const char *>(base) + (chunk.fileOffset - from);
+    }
+
+    while (m_mappings.size() > first) {
+        releaseMapping(m_mappings.takeLast());
+    }
+    Mapping mapping;
+    mapping.segment = live;
+    mapping.fileOffset = from;
+    mapping.base = base;
+    mapping.file = file;
+    m_mappings.append(mapping);
+}
+
+void LogViewerModel::startIndexing()
+{
+    if (m_indexWatcher.isRunning() || m_pendingChunks.isEmpty()) {
+        return;
+    }
+    m_indexWatcher.setFuture(QtConcurrent::run(indexChunk, m_pendingChunks.head()));
+}
+
+void LogViewerModel::startFiltering()
+{
+    if (m_filter.isNull() || m_filterWatcher.isRunning() || m_filteredUpTo >= m_lineCount) {
+        return;
+    }
+
+    QList<FilterBlock> blocks;
+    for (int from = m_filteredUpTo; from < m_lineCount; from += LOG_FILTER_BLOCK) {
+        FilterBlock block;
+        block.from = from;
+        block.to = qMin(from + LOG_FILTER_BLOCK, m_lineCount);
+        blocks.append(block);
+    }
+
+    m_filterJobTo = m_lineCount;
+    m_nextFilterBlock = 0;
+    m_filterResults.clear();
+    m_filterWatcher.setFuture(QtConcurrent::mapped(blocks, FilterFunctor(m_chunks, m_filter)));
+}
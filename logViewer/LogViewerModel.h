@@ -0,0 +1,124 @@
+#ifndef LOGVIEWERMODEL_H
+#define LOGVIEWERMODEL_H
+
+#include <QAbstractListModel>
+#include <QFutureWatcher>
+#include <QRegularExpression>
+#include <QQueue>
+#include <QMap>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+class QFile;
+
+// A run of complete lines inside one memory mapped segment file.
+struct LogChunk {
+    int segment;
+    const char *data;
+    qint64 fileOffset;
+    qint64 size;
+    int firstLine;
+    int lineCount;
+    QVector<qint64> checkpoints;    // offset of every LOG_CHECKPOINT_STRIDE-th line
+};
+
+struct LogFilter {
+    LogFilter() : minLevel(0) {}
+    bool isNull() const {return minLevel == 0 && source.isEmpty() && regex.pattern().isEmpty();}
+
+    int minLevel;                   // 0 debug ... 4 fatal
+    QByteArray source;              // substring of the %{file} field
+    QRegularExpression regex;
+};
+
+class LogViewerModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Level {
+        DebugLevel = 0,
+        InfoLevel,
+        WarnLevel,
+        CriticalLevel,
+        FatalLevel
+    };
+
+    explicit LogViewerModel(QObject *parent = 0);
+    ~LogViewerModel();
+
+    bool openLogFile(const QString &filePath);
+    void close();
+    QString filePath() const {return m_filePath;}
+
+    void setFilter(const LogFilter &filter);
+    LogFilter filter() const {return m_filter;}
+    void setFollow(bool enable);
+    bool isFollowing() const {return m_followTimer.isActive();}
+
+    int lineCount() const {return m_lineCount;}
+    bool isBusy() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    static int lineLevel(const char *line, int length);
+
+signals:
+    void progressChanged();
+
+private slots:
+    void onIndexFinished();
+    void onFilterResultReady(int index);
+    void onFilterFinished();
+    void onFollowTimeout();
+
+private:
+    struct Mapping {
+        int segment;
+        qint64 fileOffset;
+        uchar *base;
+        QFile *file;                // mapped from, owned unless the segment file
+    };
+
+    bool appendSegment(const QString &path, bool live);
+    QList<QByteArray> backupIdentities() const;
+    void appendMissedBackups();
+    void dropStaleSegments();
+    void removeSegments(int count);
+    qint64 mapSegment(int segment, qint64 from, qint64 to, bool includeTail);
+    void releaseMapping(const Mapping &mapping);
+    void mergeLiveMappings();
+    void startIndexing();
+    void startFiltering();
+    void appendFilterMatches(const QVector<int> &matches);
+    void markFilterMatch(int line);
+    int filteredLine(int row) const;
+
+    QString m_filePath;
+    QList<QFile *> m_files;
+    QStringList m_paths;
+    QList<QByteArray> m_identities;
+    QList<Mapping> m_mappings;
+    qint64 m_liveEnd;
+
+    QVector<LogChunk> m_chunks;
+    QQueue<LogChunk> m_pendingChunks;
+    int m_lineCount;
+    QFutureWatcher<LogChunk> m_indexWatcher;
+
+    LogFilter m_filter;
+    QVector<quint64> m_filterBits;  // one bit per line, set when it matches
+    QVector<int> m_filterRank;      // matches before every LOG_RANK_STRIDE lines
+    int m_filteredRows;
+    int m_filteredUpTo;
+    int m_filterJobTo;
+    int m_nextFilterBlock;
+    QMap<int, QVector<int> > m_filterResults;
+    QFutureWatcher<QVector<int> > m_filterWatcher;
+
+    QTimer m_followTimer;
+};
+
+#endif // LOGVIEWERMODEL_H
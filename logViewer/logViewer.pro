@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Viewer for the rotated log file sets of QAppLogging
+#
+#-------------------------------------------------
+
+QT       += core gui concurrent
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = logViewer
+TEMPLATE = app
+
+
+SOURCES += main.cpp\
+        LogViewer.cpp \
+        LogViewerModel.cpp
+
+HEADERS  += LogViewer.h \
+        LogViewerModel.h
@@ -0,0 +1,14 @@
+#include "LogViewer.h"
+#include <QApplication>
+
+int main(int argc, char *argv[])
+{
+    QApplication a(argc, argv);
+    LogViewer w;
+    if (argc > 1) {
+        w.openLogFile(QString::fromLocal8Bit(argv[1]));
+    }
+    w.show();
+
+    return a.exec();
+}